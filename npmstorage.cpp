@@ -1,19 +1,89 @@
 #include <npmstorage.hpp>
 
+template<typename I, typename K>
+typename I::const_iterator npmstorage::db_find(const I &index, const K &key){
+  INSTRUMENT_COUNT(finds, 1);
+  return index.find(key);
+}
+
+template<typename I, typename K>
+typename I::const_iterator npmstorage::db_lower_bound(const I &index, const K &key){
+  INSTRUMENT_COUNT(lower_bounds, 1);
+  return index.lower_bound(key);
+}
+
+template<typename I>
+typename I::const_iterator npmstorage::db_begin(const I &index){
+  INSTRUMENT_COUNT(begins, 1);
+  return index.begin();
+}
+
+template<typename It>
+void npmstorage::db_next(It &iterator){
+  INSTRUMENT_COUNT(nexts, 1);
+  iterator++;
+}
+
+template<typename I, typename R>
+typename I::const_iterator npmstorage::db_iterator_to(const I &index, const R &row){
+  INSTRUMENT_COUNT(finds, 1);
+  return index.iterator_to(row);
+}
+
+template<typename T>
+uint64_t npmstorage::db_available_primary_key(const T &table){
+  INSTRUMENT_COUNT(available_primary_keys, 1);
+  return table.available_primary_key();
+}
+
+template<typename T, typename F>
+typename T::const_iterator npmstorage::db_emplace(T &table, name payer, F &&constructor){
+  INSTRUMENT_COUNT(emplaces, 1);
+  return table.emplace(payer, [&](auto &row) {
+    constructor(row);
+    INSTRUMENT_WRITE(row);
+  });
+}
+
+template<typename I, typename F>
+void npmstorage::db_modify(I &index, typename I::const_iterator iterator, name payer, F &&updater){
+  INSTRUMENT_COUNT(modifies, 1);
+  index.modify(iterator, payer, [&](auto &row) {
+    updater(row);
+    INSTRUMENT_WRITE(row);
+  });
+}
+
+template<typename I>
+typename I::const_iterator npmstorage::db_erase(I &index, typename I::const_iterator iterator){
+  INSTRUMENT_COUNT(erases, 1);
+  return index.erase(iterator);
+}
+
+checksum256 npmstorage::hash_sha256(const char *data, std::size_t length){
+  INSTRUMENT_COUNT(bytes_hashed, length);
+  return sha256(data, length);
+}
+
+void npmstorage::check_sha256(const char *data, std::size_t length, const checksum256 &hash){
+  INSTRUMENT_COUNT(bytes_hashed, length);
+  assert_sha256(data, length, hash);
+}
+
 
 
 uint32_t npmstorage::add_value_to_stringstore(name user, std::string value, bool error_if_exists){
-  checksum256 value_hash = sha256(value.c_str(), value.length());
+  checksum256 value_hash = hash_sha256(value.c_str(), value.length());
   
   auto stringstore_hash_index = tbl_stringstore.get_index<"byhash"_n>();
-  auto stringstore_hash_iterator = stringstore_hash_index.find(value_hash);
+  auto stringstore_hash_iterator = db_find(stringstore_hash_index, value_hash);
 
   if(stringstore_hash_iterator == stringstore_hash_index.end()){
-    uint64_t new_id_64 = tbl_stringstore.available_primary_key();
+    uint64_t new_id_64 = db_available_primary_key(tbl_stringstore);
     eosio::check(new_id_64 < 0xffffffff, "string store is full (new id overflow)!");
     uint32_t new_id = (uint32_t)(new_id_64);
 
-    tbl_stringstore.emplace(user, [&](auto &row) {
+    db_emplace(tbl_stringstore, user, [&](auto &row) {
       row.id = new_id;
       row.value = value;
       row.value_hash = value_hash;
@@ -27,17 +97,17 @@ uint32_t npmstorage::add_value_to_stringstore(name user, std::string value, bool
 }
 
 uint32_t npmstorage::add_value_to_packagenames(name user, std::string package_name, bool error_if_exists){
-  checksum256 package_name_hash = sha256(package_name.c_str(), package_name.length());
+  checksum256 package_name_hash = hash_sha256(package_name.c_str(), package_name.length());
   
   auto packagenames_hash_index = tbl_packagenames.get_index<"byhash"_n>();
-  auto packagenames_hash_iterator = packagenames_hash_index.find(package_name_hash);
+  auto packagenames_hash_iterator = db_find(packagenames_hash_index, package_name_hash);
 
   if(packagenames_hash_iterator == packagenames_hash_index.end()){
-    uint64_t new_id_64 = tbl_packagenames.available_primary_key();
+    uint64_t new_id_64 = db_available_primary_key(tbl_packagenames);
     eosio::check(new_id_64 < 0xffffffff, "package names is full (new id overflow)!");
     uint32_t new_id = (uint32_t)(new_id_64);
 
-    tbl_packagenames.emplace(user, [&](auto &row) {
+    db_emplace(tbl_packagenames, user, [&](auto &row) {
       row.id = new_id;
       row.package_name = package_name;
       row.package_name_hash = package_name_hash;
@@ -54,9 +124,9 @@ uint32_t npmstorage::add_value_to_packagenames(name user, std::string package_na
 uint64_t npmstorage::add_package_version(name user, std::string package_and_version, bool error_if_exists){
   eosio::check(package_and_version.length() >= 7, "package_and_version must be at least of length 7 (ex. a@0.0.0)!");
 
-  checksum256 package_and_version_hash = sha256(package_and_version.c_str(), package_and_version.length());
+  checksum256 package_and_version_hash = hash_sha256(package_and_version.c_str(), package_and_version.length());
   auto packageversions_hash_index = tbl_packageversions.get_index<"byhash"_n>();
-  auto packageversions_hash_iterator = packageversions_hash_index.find(package_and_version_hash);
+  auto packageversions_hash_iterator = db_find(packageversions_hash_index, package_and_version_hash);
 
   if(packageversions_hash_iterator == packageversions_hash_index.end()){
 
@@ -77,9 +147,10 @@ uint64_t npmstorage::add_package_version(name user, std::string package_and_vers
       prerelease_full_sid
     );
 
-    uint64_t new_id = tbl_packageversions.available_primary_key();
+    uint64_t new_id = db_available_primary_key(tbl_packageversions);
 
-    tbl_packageversions.emplace(user, [&](auto &row) {
+    db_emplace(tbl_packageversions, user, [&](auto &row) {
+      migrate_row(row);
       row.id = new_id;
       row.package_and_version = parsed_package_version.package_and_version;
       row.package_and_version_hash = package_and_version_hash;
@@ -124,7 +195,7 @@ bool npmstorage::claim_repo(name user, name repo) {
   }
 }
 auto npmstorage::assert_can_upsert_repo(name user, name repo) {
-  auto repos_iterator = tbl_repos.find(repo.value);
+  auto repos_iterator = db_find(tbl_repos, repo.value);
   if(repos_iterator == tbl_repos.end()){
     eosio::check(claim_repo(user, repo) == true,
       "user does not have the right to claim this repo");
@@ -137,14 +208,14 @@ auto npmstorage::assert_can_upsert_repo(name user, name repo) {
 }
 
 auto npmstorage::assert_user_owns_repo(name user, name repo) {
-  auto repos_iterator = tbl_repos.find(repo.value);
+  auto repos_iterator = db_find(tbl_repos, repo.value);
   eosio::check(repos_iterator != tbl_repos.end(), "repo does not exist!");
   eosio::check((repos_iterator->owner).value == user.value, "user does not own this repo!");
   return repos_iterator;
 }
 
 auto npmstorage::assert_user_owns_release(name user, uint64_t release_id) {
-  auto releases_iterator = tbl_releases.find(release_id);
+  auto releases_iterator = db_find(tbl_releases, release_id);
   eosio::check(releases_iterator != tbl_releases.end(), "release does not exist!");
   assert_user_owns_repo(user, releases_iterator->repo);
   return releases_iterator;
@@ -159,16 +230,19 @@ void npmstorage::upsert_repo_content(name user, name repo, std::string title, st
   auto repos_iterator = assert_can_upsert_repo(user, repo);
 
   if(repos_iterator == tbl_repos.end()){
-    tbl_repos.emplace(user, [&](auto &row) {
+    db_emplace(tbl_repos, user, [&](auto &row) {
+      migrate_row(row);
       row.repo = repo;
       row.owner = user;
       row.title = title;
       row.description = description;
       row.url = url;
       row.icon = icon;
+      row.status = REPO_STATUS_ACTIVE;
     });
   }else{
-    tbl_repos.modify(repos_iterator, user, [&](auto &row) {
+    db_modify(tbl_repos, repos_iterator, user, [&](auto &row) {
+      migrate_row(row);
       row.title = title;
       row.description = description;
       row.url = url;
@@ -177,21 +251,31 @@ void npmstorage::upsert_repo_content(name user, name repo, std::string title, st
   }
 }
 
+void npmstorage::set_repo_status(name user, name repo, uint32_t status){
+  eosio::check(status == REPO_STATUS_ACTIVE || status == REPO_STATUS_DISABLED, "invalid repo status!");
+  auto repos_iterator = assert_user_owns_repo(user, repo);
+  db_modify(tbl_repos, repos_iterator, user, [&](auto &row) {
+    migrate_row(row);
+    row.status = status;
+  });
+}
+
 
 
 void npmstorage::add_new_release(name user, name repo, std::string package_and_version, uint32_t load_order) {
   eosio::check(load_order == LOAD_ORDER_STRICT || load_order == LOAD_ORDER_ANY, "invalid load order!");
   uint64_t packageversion_id = add_package_version(user, package_and_version, false);
 
-  auto packageversions_iterator = tbl_packageversions.find(packageversion_id);
+  auto packageversions_iterator = db_find(tbl_packageversions, packageversion_id);
   eosio::check(packageversions_iterator != tbl_packageversions.end(), "invalid packageversion_id after creation!");
 
   uint64_t current_time = eosio::current_time_point().sec_since_epoch();
 
 
 
-  uint64_t new_release_id = tbl_releases.available_primary_key();
-  tbl_releases.emplace(user, [&](auto &row) {
+  uint64_t new_release_id = db_available_primary_key(tbl_releases);
+  db_emplace(tbl_releases, user, [&](auto &row) {
+    migrate_row(row);
     row.id = new_release_id;
 
     row.repo = repo;
@@ -207,7 +291,8 @@ void npmstorage::add_new_release(name user, name repo, std::string package_and_v
   });
 
 
-  tbl_packageversions.modify(packageversions_iterator, user, [&](auto &row) {
+  db_modify(tbl_packageversions, packageversions_iterator, user, [&](auto &row) {
+    migrate_row(row);
     row.num_releases = row.num_releases+1;
   });
 }
@@ -216,9 +301,11 @@ void npmstorage::set_release_status(name user, uint64_t release_id, uint32_t sta
   eosio::check(status == RELEASE_STATUS_DISABLED || status == RELEASE_STATUS_ACTIVE, "invalid release status!");
   auto releases_iterator = assert_user_owns_release(user, release_id);
   eosio::check(releases_iterator != tbl_releases.end(), "release does not exist!");
-  tbl_releases.modify(releases_iterator, user, [&](auto &row) {
+  db_modify(tbl_releases, releases_iterator, user, [&](auto &row) {
+    migrate_row(row);
     row.status = status;
   });
+  notify_release_change(*releases_iterator, CHANGE_RELEASE_STATUS);
 }
 
 
@@ -226,9 +313,11 @@ void npmstorage::set_release_load_order(name user, uint64_t release_id, uint32_t
   eosio::check(load_order == LOAD_ORDER_STRICT || load_order == LOAD_ORDER_ANY, "invalid load order!");
   auto releases_iterator = assert_user_owns_release(user, release_id);
   eosio::check(releases_iterator != tbl_releases.end(), "release does not exist!");
-  tbl_releases.modify(releases_iterator, user, [&](auto &row) {
+  db_modify(tbl_releases, releases_iterator, user, [&](auto &row) {
+    migrate_row(row);
     row.load_order = load_order;
   });
+  notify_release_change(*releases_iterator, CHANGE_RELEASE_LOAD_ORDER);
 }
 
 void npmstorage::add_release_file(name user, uint64_t release_id, checksum256 filehash, std::string alt_sources, std::string externals, uint32_t file_type, uint32_t load_index){
@@ -244,20 +333,21 @@ void npmstorage::add_release_file(name user, uint64_t release_id, checksum256 fi
   checksum256 rloadindex = get_rloadindex(release_id, load_index);
 
   auto rloadindex_index = tbl_releasefiles.get_index<"byrloadindex"_n>();
-  auto rloadindex_index_iterator = rloadindex_index.find(rloadindex);
+  auto rloadindex_index_iterator = db_find(rloadindex_index, rloadindex);
   eosio::check(rloadindex_index_iterator == rloadindex_index.end(), "file already already exists with this load_index");
 
   if(load_index > 0){
-    auto prev_file_iterator = rloadindex_index.find(get_rloadindex(release_id, load_index-1));
+    auto prev_file_iterator = db_find(rloadindex_index, get_rloadindex(release_id, load_index-1));
     eosio::check(prev_file_iterator != rloadindex_index.end(), "the previous load_index has not yet been populated!");
   }
   auto data_hash_index = tbl_resources.get_index<"datahashidx"_n>();
-  auto data_hash_iterator = data_hash_index.find(filehash);
+  auto data_hash_iterator = db_find(data_hash_index, filehash);
   eosio::check(data_hash_iterator != data_hash_index.end(), "resource does not exist");
 
 
-  uint64_t new_id = tbl_releasefiles.available_primary_key();
-  tbl_releasefiles.emplace(user, [&](auto &row) {
+  uint64_t new_id = db_available_primary_key(tbl_releasefiles);
+  db_emplace(tbl_releasefiles, user, [&](auto &row) {
+    migrate_row(row);
     row.id = new_id;
     row.release_id = release_id;
     row.package_version_id = releases_iterator->package_version_id;
@@ -273,6 +363,226 @@ void npmstorage::add_release_file(name user, uint64_t release_id, checksum256 fi
     row.externals = externals;
     row.rloadindex = rloadindex;
   });
+  notify_release_change(*releases_iterator, CHANGE_RELEASE_FILE_ADDED);
+}
+
+void npmstorage::swap_release_file_load_index(name user, uint64_t release_id, uint64_t releasefile_id_a, uint64_t releasefile_id_b){
+  eosio::check(releasefile_id_a != releasefile_id_b, "cannot swap a release file with itself!");
+  auto releases_iterator = assert_user_owns_release(user, release_id);
+
+  auto releasefile_a_iterator = db_find(tbl_releasefiles, releasefile_id_a);
+  eosio::check(releasefile_a_iterator != tbl_releasefiles.end(), "release file a does not exist!");
+  eosio::check(releasefile_a_iterator->release_id == release_id, "release file a does not belong to this release!");
+
+  auto releasefile_b_iterator = db_find(tbl_releasefiles, releasefile_id_b);
+  eosio::check(releasefile_b_iterator != tbl_releasefiles.end(), "release file b does not exist!");
+  eosio::check(releasefile_b_iterator->release_id == release_id, "release file b does not belong to this release!");
+
+  uint32_t load_index_a = releasefile_a_iterator->load_index;
+  uint32_t load_index_b = releasefile_b_iterator->load_index;
+
+  db_modify(tbl_releasefiles, releasefile_a_iterator, user, [&](auto &row) {
+    migrate_row(row);
+    row.load_index = load_index_b;
+    row.rloadindex = get_rloadindex(release_id, load_index_b);
+  });
+  db_modify(tbl_releasefiles, releasefile_b_iterator, user, [&](auto &row) {
+    migrate_row(row);
+    row.load_index = load_index_a;
+    row.rloadindex = get_rloadindex(release_id, load_index_a);
+  });
+  notify_release_change(*releases_iterator, CHANGE_RELEASE_FILES_SWAPPED);
+}
+
+void npmstorage::notify_release_change(const s_tbl_releases &release, name change){
+  uint64_t change_seq = 1;
+  auto changeseqs_iterator = db_find(tbl_changeseqs, release.repo.value);
+  if(changeseqs_iterator == tbl_changeseqs.end()){
+    db_emplace(tbl_changeseqs, get_self(), [&](auto &row) {
+      row.repo = release.repo;
+      row.change_seq = change_seq;
+    });
+  }else{
+    change_seq = changeseqs_iterator->change_seq+1;
+    db_modify(tbl_changeseqs, changeseqs_iterator, same_payer, [&](auto &row) {
+      row.change_seq = change_seq;
+    });
+  }
+
+  logchange_action logchange_notification(get_self(), {get_self(), "active"_n});
+  logchange_notification.send(release.repo, change_seq, change, release.id, release.package_name_id);
+}
+
+uint64_t npmstorage::add_chunk(name user, const char *data, std::size_t length){
+  checksum256 chunk_hash = hash_sha256(data, length);
+
+  auto chunks_hash_index = tbl_chunks.get_index<"byhash"_n>();
+  auto chunks_hash_iterator = db_find(chunks_hash_index, chunk_hash);
+
+  if(chunks_hash_iterator == chunks_hash_index.end()){
+    uint64_t new_id = db_available_primary_key(tbl_chunks);
+    db_emplace(tbl_chunks, user, [&](auto &row) {
+      row.id = new_id;
+      row.sha256hash = chunk_hash;
+      row.data = std::string(data, length);
+    });
+    return new_id;
+  }else{
+    return chunks_hash_iterator->id;
+  }
+}
+
+std::string npmstorage::get_resource_data(const s_tbl_resources &resource){
+  if(!resource.is_chunked()){
+    return resource.data;
+  }
+  std::string data;
+  for(uint64_t chunk_id : resource.chunk_ids.value()){
+    auto chunks_iterator = db_find(tbl_chunks, chunk_id);
+    eosio::check(chunks_iterator != tbl_chunks.end(), "resource references a missing chunk!");
+    data.append(chunks_iterator->data);
+  }
+  return data;
+}
+
+uint64_t npmstorage::get_resource_length(const s_tbl_resources &resource){
+  if(!resource.is_chunked()){
+    return resource.data.length();
+  }
+  eosio::check(resource.chunked_length.has_value(), "chunked resource is missing its length!");
+  return resource.chunked_length.value();
+}
+
+// binary_extension fields are serialized in order, so every older extension must be filled before schema_version
+void npmstorage::migrate_row(s_tbl_packageversions &row){
+  row.schema_version.emplace(SCHEMA_VERSION_PACKAGEVERSIONS);
+}
+
+void npmstorage::migrate_row(s_tbl_repos &row){
+  row.schema_version.emplace(SCHEMA_VERSION_REPOS);
+}
+
+void npmstorage::migrate_row(s_tbl_releases &row){
+  row.schema_version.emplace(SCHEMA_VERSION_RELEASES);
+}
+
+void npmstorage::migrate_row(s_tbl_releasefiles &row){
+  row.schema_version.emplace(SCHEMA_VERSION_RELEASEFILES);
+}
+
+void npmstorage::migrate_row(s_tbl_resources &row){
+  if(!row.chunk_ids.has_value()){
+    row.chunk_ids.emplace();
+  }
+  // chunked rows always record their length when written, so only unchunked rows can be missing it
+  if(!row.chunked_length.has_value()){
+    row.chunked_length.emplace(0);
+  }
+  row.schema_version.emplace(SCHEMA_VERSION_RESOURCES);
+}
+
+template<typename I, typename R, typename V>
+uint64_t npmstorage::walk_page(const I &index, typename I::const_iterator iterator, R in_range, uint32_t max_rows, uint32_t max_bytes, V visit){
+  uint32_t visited_rows = 0;
+  std::size_t visited_bytes = 0;
+  while(iterator != index.end() && in_range(*iterator)){
+    std::size_t row_size = eosio::pack_size(*iterator);
+    if(visited_rows == max_rows || (visited_rows > 0 && visited_bytes + row_size > max_bytes)){
+      return iterator->primary_key() + 1;
+    }
+    visit(iterator);
+    visited_rows++;
+    visited_bytes += row_size;
+    db_next(iterator);
+  }
+  return 0;
+}
+
+template<typename T, typename V>
+uint64_t npmstorage::walk_table_page(T &table, uint64_t cursor, uint32_t max_bytes, V visit){
+  auto table_iterator = cursor == 0 ? db_begin(table) : db_lower_bound(table, cursor - 1);
+  return walk_page(table, table_iterator, [](const auto &) { return true; }, UINT32_MAX, max_bytes, visit);
+}
+
+template<typename T, uint32_t readable_version>
+uint64_t npmstorage::migrate_table_rows(T &table, uint64_t cursor, uint32_t max_bytes){
+  // no layout has been retired yet, so there is nothing to rewrite and no reason to load any rows
+  if constexpr(readable_version == 0){
+    return 0;
+  }
+
+  // every row is loaded to read its version, so max_bytes bounds the rows read and not only the rows rewritten
+  return walk_table_page(table, cursor, max_bytes, [&](auto table_iterator) {
+    if(table_iterator->get_schema_version() < readable_version){
+      // rows keep their payer and the chain rejects growing a row paid by another account,
+      // so only a layout that keeps or shrinks row sizes can be retired this way
+      db_modify(table, table_iterator, same_payer, [&](auto &row) {
+        migrate_row(row);
+      });
+    }
+  });
+}
+
+template<typename P, typename T, typename I, typename K, typename F>
+void npmstorage::query_index_page(T &table, I &index, const K &lower_key, F in_range, uint64_t cursor, uint32_t limit, P &page){
+  eosio::check(limit > 0 && limit <= QUERY_MAX_ROWS, "limit must be > 0 and <= QUERY_MAX_ROWS");
+
+  auto index_iterator = index.end();
+  if(cursor == 0){
+    index_iterator = db_lower_bound(index, lower_key);
+  }else{
+    // jump straight to the cursor's row in the secondary index instead of walking from lower_key
+    auto table_iterator = db_find(table, cursor - 1);
+    eosio::check(table_iterator != table.end() && in_range(*table_iterator), "query cursor is no longer valid, restart the query");
+    index_iterator = db_iterator_to(index, *table_iterator);
+  }
+
+  page.next_cursor = walk_page(index, index_iterator, in_range, limit, QUERY_MAX_PAGE_BYTES, [&](auto row_iterator) {
+    page.rows.push_back(*row_iterator);
+  });
+}
+
+bool npmstorage::append_resource_payload(const s_tbl_resources &resource, uint32_t max_bytes, uint64_t &page_bytes, resources_page_t &page){
+  // size the resource before reassembling it so that resources which do not fit cost nothing
+  uint64_t resource_length = get_resource_length(resource);
+  // same at-least-one rule as walk_page
+  if(!page.resources.empty() && page_bytes + resource_length > max_bytes){
+    return false;
+  }
+
+  page.resources.push_back(resource_payload_t{resource.sha256hash, true, resource.rid, get_resource_data(resource)});
+  page_bytes += resource_length;
+  return true;
+}
+
+template<typename T>
+void npmstorage::export_snapshot_rows(T &table, uint64_t cursor, uint32_t max_bytes, snapshot_page_t &page){
+  page.next_cursor = walk_table_page(table, cursor, max_bytes, [&](auto table_iterator) {
+    page.rows.push_back(eosio::pack(*table_iterator));
+    page.row_count++;
+  });
+}
+
+template<typename R, typename T>
+void npmstorage::import_snapshot_rows(T &table, const std::vector<std::vector<char>> &rows){
+  for(const auto &packed_row : rows){
+    R imported_row = eosio::unpack<R>(packed_row);
+    verify_snapshot_row(imported_row);
+    eosio::check(db_find(table, imported_row.primary_key()) == table.end(), "snapshot row already exists!");
+    db_emplace(table, get_self(), [&](auto &row) {
+      row = imported_row;
+    });
+  }
+}
+
+void npmstorage::verify_snapshot_row(const s_tbl_resources &row){
+  // chunked resources are verified against the chunks table, so chunks must be imported first
+  std::string data = get_resource_data(row);
+  check_sha256(data.c_str(), data.length(), row.sha256hash);
+}
+
+void npmstorage::verify_snapshot_row(const s_tbl_chunks &row){
+  check_sha256(row.data.c_str(), row.data.length(), row.sha256hash);
 }
 
 
@@ -287,53 +597,117 @@ ACTION npmstorage::addpkgver(name user, std::string package_and_version){
 
 */
 
+uint64_t npmstorage::migrate(name table, uint64_t cursor, uint32_t max_bytes){
+  // rewrites rows below the table's SCHEMA_READABLE_* version in batches of max_bytes read, returns the cursor for the
+  // next batch (0 when done). rows keep their payer, so this only handles layouts that do not grow rows
+  require_auth(get_self());
+  eosio::check(max_bytes > 0 && max_bytes <= MIGRATE_MAX_BATCH_BYTES, "max_bytes must be > 0 and <= MIGRATE_MAX_BATCH_BYTES");
+
+  if(table == "pkgversions"_n){
+    return migrate_table_rows<t_tbl_packageversions, SCHEMA_READABLE_PACKAGEVERSIONS>(tbl_packageversions, cursor, max_bytes);
+  }else if(table == "repos"_n){
+    return migrate_table_rows<t_tbl_repos, SCHEMA_READABLE_REPOS>(tbl_repos, cursor, max_bytes);
+  }else if(table == "releases"_n){
+    return migrate_table_rows<t_tbl_releases, SCHEMA_READABLE_RELEASES>(tbl_releases, cursor, max_bytes);
+  }else if(table == "releasefiles"_n){
+    return migrate_table_rows<t_tbl_releasefiles, SCHEMA_READABLE_RELEASEFILES>(tbl_releasefiles, cursor, max_bytes);
+  }else if(table == "resources"_n){
+    return migrate_table_rows<t_tbl_resources, SCHEMA_READABLE_RESOURCES>(tbl_resources, cursor, max_bytes);
+  }
+  eosio::check(false, "table has no schema version!");
+  return 0;
+}
+
 ACTION npmstorage::devclearall(){
   // FOR DEVELOPMENT/TESTING NETWORKS ONLY: delete this action if shipping to the mainnet!
   require_auth(DEBUG_CONTRACT_ADMIN);
 
-  auto packageversions_iterator = tbl_packageversions.begin();
+  auto packageversions_iterator = db_begin(tbl_packageversions);
   while (packageversions_iterator != tbl_packageversions.end()) {
-    packageversions_iterator = tbl_packageversions.erase(packageversions_iterator);
+    packageversions_iterator = db_erase(tbl_packageversions, packageversions_iterator);
   }
   
-  auto packagenames_iterator = tbl_packagenames.begin();
+  auto packagenames_iterator = db_begin(tbl_packagenames);
   while (packagenames_iterator != tbl_packagenames.end()) {
-    packagenames_iterator = tbl_packagenames.erase(packagenames_iterator);
+    packagenames_iterator = db_erase(tbl_packagenames, packagenames_iterator);
   }
 
-  auto stringstore_iterator = tbl_stringstore.begin();
+  auto stringstore_iterator = db_begin(tbl_stringstore);
   while (stringstore_iterator != tbl_stringstore.end()) {
-    stringstore_iterator = tbl_stringstore.erase(stringstore_iterator);
+    stringstore_iterator = db_erase(tbl_stringstore, stringstore_iterator);
   }
 
-  auto releases_iterator = tbl_releases.begin();
+  auto releases_iterator = db_begin(tbl_releases);
   while (releases_iterator != tbl_releases.end()) {
-    releases_iterator = tbl_releases.erase(releases_iterator);
+    releases_iterator = db_erase(tbl_releases, releases_iterator);
   }
 
-  auto releasefiles_iterator = tbl_releasefiles.begin();
+  auto releasefiles_iterator = db_begin(tbl_releasefiles);
   while (releasefiles_iterator != tbl_releasefiles.end()) {
-    releasefiles_iterator = tbl_releasefiles.erase(releasefiles_iterator);
+    releasefiles_iterator = db_erase(tbl_releasefiles, releasefiles_iterator);
   }
 
-  auto repos_iterator = tbl_repos.begin();
+  auto repos_iterator = db_begin(tbl_repos);
   while (repos_iterator != tbl_repos.end()) {
-    repos_iterator = tbl_repos.erase(repos_iterator);
+    repos_iterator = db_erase(tbl_repos, repos_iterator);
   }
   
-  auto resources_iterator = tbl_resources.begin();
+  auto resources_iterator = db_begin(tbl_resources);
   while (resources_iterator != tbl_resources.end()) {
-    resources_iterator = tbl_resources.erase(resources_iterator);
+    resources_iterator = db_erase(tbl_resources, resources_iterator);
+  }
+
+  auto chunks_iterator = db_begin(tbl_chunks);
+  while (chunks_iterator != tbl_chunks.end()) {
+    chunks_iterator = db_erase(tbl_chunks, chunks_iterator);
+  }
+
+  auto changeseqs_iterator = db_begin(tbl_changeseqs);
+  while (changeseqs_iterator != tbl_changeseqs.end()) {
+    changeseqs_iterator = db_erase(tbl_changeseqs, changeseqs_iterator);
   }
   
 }
 
+ACTION npmstorage::devimport(name table, uint32_t format_version, std::vector<std::vector<char>> rows){
+  // FOR DEVELOPMENT/TESTING NETWORKS ONLY: loads rows exported by the snapshot action into an empty environment
+  require_auth(DEBUG_CONTRACT_ADMIN);
+  eosio::check(format_version == SNAPSHOT_FORMAT_VERSION, "unsupported snapshot format version!");
+
+  if(table == "stringstore"_n){
+    import_snapshot_rows<s_tbl_stringstore>(tbl_stringstore, rows);
+  }else if(table == "pkgnames"_n){
+    import_snapshot_rows<s_tbl_packagenames>(tbl_packagenames, rows);
+  }else if(table == "pkgversions"_n){
+    import_snapshot_rows<s_tbl_packageversions>(tbl_packageversions, rows);
+  }else if(table == "repos"_n){
+    import_snapshot_rows<s_tbl_repos>(tbl_repos, rows);
+  }else if(table == "releases"_n){
+    import_snapshot_rows<s_tbl_releases>(tbl_releases, rows);
+  }else if(table == "releasefiles"_n){
+    import_snapshot_rows<s_tbl_releasefiles>(tbl_releasefiles, rows);
+  }else if(table == "resources"_n){
+    import_snapshot_rows<s_tbl_resources>(tbl_resources, rows);
+  }else if(table == "chunks"_n){
+    import_snapshot_rows<s_tbl_chunks>(tbl_chunks, rows);
+  }else if(table == "changeseqs"_n){
+    import_snapshot_rows<s_tbl_changeseqs>(tbl_changeseqs, rows);
+  }else{
+    eosio::check(false, "unknown snapshot table!");
+  }
+}
+
 
 ACTION npmstorage::upsertrepo(name user, name repo, std::string title, std::string description, std::string url, std::string icon){
   require_auth(user);
   upsert_repo_content(user, repo, title, description, url, icon);
 }
 
+ACTION npmstorage::setrepoon(name user, name repo, uint32_t status){
+  require_auth(user);
+  set_repo_status(user, repo, status);
+}
+
 ACTION npmstorage::addrelease(name user, name repo, std::string package_and_version, uint32_t load_order){
   require_auth(user);
   add_new_release(user, repo, package_and_version, load_order);
@@ -360,7 +734,16 @@ ACTION npmstorage::addrelfile(name user, uint64_t release_id, checksum256 fileha
 }
 
 ACTION npmstorage::swaploadind(name user, uint64_t release_id, uint64_t releasefile_id_a, uint64_t releasefile_id_b){
+  require_auth(user);
+  swap_release_file_load_index(user, release_id, releasefile_id_a, releasefile_id_b);
+}
+
+ACTION npmstorage::logchange(name repo, uint64_t change_seq, name change, uint64_t release_id, uint32_t package_name_id){
+  require_auth(get_self());
+}
 
+ACTION npmstorage::logresource(uint64_t rid, checksum256 sha256hash, name uploader){
+  require_auth(get_self());
 }
 
 
@@ -370,17 +753,165 @@ ACTION npmstorage::add(name uploader, checksum256 sha256hash, std::string data)
   require_auth(uploader);
 
   // ensure that the sha256hash passed by the user is the real sha256 hash of data
-  assert_sha256(data.c_str(), data.length(), sha256hash);
+  check_sha256(data.c_str(), data.length(), sha256hash);
 
   auto data_hash_index = tbl_resources.get_index<"datahashidx"_n>();
-  auto data_hash_iterator = data_hash_index.find(sha256hash);
+  auto data_hash_iterator = db_find(data_hash_index, sha256hash);
   eosio::check(data_hash_iterator == data_hash_index.end(), "resource already exists");
 
-  uint64_t new_rid = tbl_resources.available_primary_key();
-  tbl_resources.emplace(uploader, [&](auto &row) {
+  uint64_t new_rid = db_available_primary_key(tbl_resources);
+  db_emplace(tbl_resources, uploader, [&](auto &row) {
+    migrate_row(row);
     row.rid = new_rid;
     row.uploader = uploader;
     row.sha256hash = sha256hash;
     row.data = data;
   });
+
+  logresource_action logresource_notification(get_self(), {get_self(), "active"_n});
+  logresource_notification.send(new_rid, sha256hash, uploader);
+}
+
+ACTION npmstorage::addchunked(name uploader, checksum256 sha256hash, std::string data) {
+  // same as add, but stores data as content-defined chunks shared with every other chunked resource
+  require_auth(uploader);
+
+  check_sha256(data.c_str(), data.length(), sha256hash);
+  eosio::check(data.length() > 0, "chunked resources must not be empty");
+
+  auto data_hash_index = tbl_resources.get_index<"datahashidx"_n>();
+  auto data_hash_iterator = db_find(data_hash_index, sha256hash);
+  eosio::check(data_hash_iterator == data_hash_index.end(), "resource already exists");
+
+  std::vector<uint64_t> chunk_ids;
+  std::size_t offset = 0;
+  while(offset < data.length()){
+    std::size_t chunk_length = get_chunk_length(data.c_str() + offset, data.length() - offset);
+    chunk_ids.push_back(add_chunk(uploader, data.c_str() + offset, chunk_length));
+    offset += chunk_length;
+  }
+
+  uint64_t new_rid = db_available_primary_key(tbl_resources);
+  db_emplace(tbl_resources, uploader, [&](auto &row) {
+    migrate_row(row);
+    row.rid = new_rid;
+    row.uploader = uploader;
+    row.sha256hash = sha256hash;
+    row.data = "";
+    row.chunk_ids.emplace(chunk_ids);
+    row.chunked_length.emplace(data.length());
+  });
+
+  logresource_action logresource_notification(get_self(), {get_self(), "active"_n});
+  logresource_notification.send(new_rid, sha256hash, uploader);
+}
+
+
+snapshot_page_t npmstorage::snapshot(name table, uint64_t cursor, uint32_t max_bytes){
+  eosio::check(max_bytes > 0 && max_bytes <= SNAPSHOT_MAX_PAGE_BYTES, "max_bytes must be > 0 and <= SNAPSHOT_MAX_PAGE_BYTES");
+
+  snapshot_page_t page;
+  page.format_version = SNAPSHOT_FORMAT_VERSION;
+  page.table = table;
+  page.row_count = 0;
+  page.next_cursor = 0;
+
+  if(table == "stringstore"_n){
+    export_snapshot_rows(tbl_stringstore, cursor, max_bytes, page);
+  }else if(table == "pkgnames"_n){
+    export_snapshot_rows(tbl_packagenames, cursor, max_bytes, page);
+  }else if(table == "pkgversions"_n){
+    export_snapshot_rows(tbl_packageversions, cursor, max_bytes, page);
+  }else if(table == "repos"_n){
+    export_snapshot_rows(tbl_repos, cursor, max_bytes, page);
+  }else if(table == "releases"_n){
+    export_snapshot_rows(tbl_releases, cursor, max_bytes, page);
+  }else if(table == "releasefiles"_n){
+    export_snapshot_rows(tbl_releasefiles, cursor, max_bytes, page);
+  }else if(table == "resources"_n){
+    export_snapshot_rows(tbl_resources, cursor, max_bytes, page);
+  }else if(table == "chunks"_n){
+    export_snapshot_rows(tbl_chunks, cursor, max_bytes, page);
+  }else if(table == "changeseqs"_n){
+    export_snapshot_rows(tbl_changeseqs, cursor, max_bytes, page);
+  }else{
+    eosio::check(false, "unknown snapshot table!");
+  }
+  return page;
+}
+
+npmstorage::repos_page_t npmstorage::listrepos(uint32_t status, uint64_t cursor, uint32_t limit){
+  repos_page_t page;
+  auto status_index = tbl_repos.get_index<"bystatus"_n>();
+  query_index_page(tbl_repos, status_index, (uint64_t)status, [&](const s_tbl_repos &row) {
+    return row.status == status;
+  }, cursor, limit, page);
+  return page;
+}
+
+npmstorage::releases_page_t npmstorage::listreleases(name repo, uint32_t package_name_id, uint64_t cursor, uint32_t limit){
+  releases_page_t page;
+  bool any_package = package_name_id == QUERY_ANY_PACKAGE_NAME_ID;
+  checksum256 lower_key = eosio::checksum256::make_from_word_sequence<uint64_t>(repo.value, any_package ? (uint64_t)0 : (uint64_t)package_name_id, (uint64_t)0, (uint64_t)0);
+
+  auto repo_pkgver_index = tbl_releases.get_index<"byrepopkgver"_n>();
+  query_index_page(tbl_releases, repo_pkgver_index, lower_key, [&](const s_tbl_releases &row) {
+    return row.repo == repo && (any_package || row.package_name_id == package_name_id);
+  }, cursor, limit, page);
+  return page;
+}
+
+npmstorage::versions_page_t npmstorage::listversions(name creator, uint64_t cursor, uint32_t limit){
+  versions_page_t page;
+  auto creator_index = tbl_packageversions.get_index<"bycreator"_n>();
+  query_index_page(tbl_packageversions, creator_index, creator.value, [&](const s_tbl_packageversions &row) {
+    return row.creator == creator;
+  }, cursor, limit, page);
+  return page;
+}
+
+npmstorage::resources_page_t npmstorage::getresources(std::vector<checksum256> hashes, uint32_t cursor, uint32_t max_bytes){
+  eosio::check(hashes.size() <= QUERY_MAX_ROWS, "hashes must contain <= QUERY_MAX_ROWS entries");
+  eosio::check(max_bytes > 0 && max_bytes <= QUERY_MAX_PAGE_BYTES, "max_bytes must be > 0 and <= QUERY_MAX_PAGE_BYTES");
+
+  resources_page_t page;
+  page.next_cursor = 0;
+  uint64_t page_bytes = 0;
+
+  auto data_hash_index = tbl_resources.get_index<"datahashidx"_n>();
+  for(uint32_t position = cursor; position < hashes.size(); position++){
+    auto data_hash_iterator = db_find(data_hash_index, hashes[position]);
+    if(data_hash_iterator == data_hash_index.end()){
+      page.resources.push_back(resource_payload_t{hashes[position], false, 0, ""});
+    }else if(!append_resource_payload(*data_hash_iterator, max_bytes, page_bytes, page)){
+      page.next_cursor = position;
+      break;
+    }
+  }
+  return page;
+}
+
+npmstorage::resources_page_t npmstorage::getrelres(uint64_t release_id, uint32_t cursor, uint32_t max_bytes){
+  eosio::check(max_bytes > 0 && max_bytes <= QUERY_MAX_PAGE_BYTES, "max_bytes must be > 0 and <= QUERY_MAX_PAGE_BYTES");
+  eosio::check(db_find(tbl_releases, release_id) != tbl_releases.end(), "release does not exist!");
+
+  resources_page_t page;
+  page.next_cursor = 0;
+  uint64_t page_bytes = 0;
+
+  // load indices are contiguous from 0, so walking byrloadindex returns files in load order
+  auto rloadindex_index = tbl_releasefiles.get_index<"byrloadindex"_n>();
+  for(uint32_t load_index = cursor; ; load_index++){
+    auto rloadindex_index_iterator = db_find(rloadindex_index, get_rloadindex(release_id, load_index));
+    if(rloadindex_index_iterator == rloadindex_index.end()){
+      break;
+    }
+    auto resources_iterator = db_find(tbl_resources, rloadindex_index_iterator->resource_id);
+    eosio::check(resources_iterator != tbl_resources.end(), "release file references a missing resource!");
+    if(!append_resource_payload(*resources_iterator, max_bytes, page_bytes, page)){
+      page.next_cursor = load_index;
+      break;
+    }
+  }
+  return page;
 }
@@ -27,9 +27,64 @@
 #define FILE_TYPE_INJECT_INLINE_CSS (FILE_MODE_INJECT_INLINE<<8 | FILE_FORMAT_CSS)
 
 
+// new releases start disabled until their owner enables them with setreleaseon, so 0 is disabled
 #define RELEASE_STATUS_DISABLED 0
 #define RELEASE_STATUS_ACTIVE 1
 
+// repos are the other way around: rows written before upsertrepo set a status hold 0 and were already live,
+// so 0 is active and they stay listed without a rewrite. only the owner disables a repo, through setrepoon
+#define REPO_STATUS_ACTIVE 0
+#define REPO_STATUS_DISABLED 1
+
+#define CHANGE_RELEASE_STATUS "relstatus"_n
+#define CHANGE_RELEASE_LOAD_ORDER "loadorder"_n
+#define CHANGE_RELEASE_FILE_ADDED "addrelfile"_n
+#define CHANGE_RELEASE_FILES_SWAPPED "swaploadind"_n
+
+#define QUERY_MAX_ROWS 100
+#define QUERY_ANY_PACKAGE_NAME_ID 0xffffffff
+#define QUERY_MAX_PAGE_BYTES 262144
+
+// content-defined chunking: boundaries are only checked after CHUNK_MIN_SIZE bytes and are cut where the top 13 bits
+// of the gear hash are zero (1 in 8KiB), so chunks average ~10KiB
+#define CHUNK_MIN_SIZE 2048
+#define CHUNK_MAX_SIZE 65536
+#define CHUNK_BOUNDARY_MASK 0xfff8000000000000ULL
+
+// row layout versions, rows written before schema versioning was added read as version 0
+#define SCHEMA_VERSION_PACKAGEVERSIONS 1
+#define SCHEMA_VERSION_REPOS 1
+#define SCHEMA_VERSION_RELEASES 1
+#define SCHEMA_VERSION_RELEASEFILES 1
+#define SCHEMA_VERSION_RESOURCES 1
+
+// oldest layout version that read paths still accept, rows below it are rewritten by the migrate action.
+// layouts that only append binary_extension fields keep these at 0 and upgrade rows on touch instead.
+// migrate keeps each row's payer, so a layout that grows rows cannot be retired by raising these
+#define SCHEMA_READABLE_PACKAGEVERSIONS 0
+#define SCHEMA_READABLE_REPOS 0
+#define SCHEMA_READABLE_RELEASES 0
+#define SCHEMA_READABLE_RELEASEFILES 0
+#define SCHEMA_READABLE_RESOURCES 0
+
+#define MIGRATE_MAX_BATCH_BYTES 65536
+
+// version 2 frames every row separately so rows extended through binary_extension stay decodable
+#define SNAPSHOT_FORMAT_VERSION 2
+#define SNAPSHOT_MAX_PAGE_BYTES 262144
+
+#define READONLY_ACTION [[eosio::action, eosio::read_only]]
+
+// build with -DNPMSTORAGE_INSTRUMENT to print per action database/hashing counters to the console,
+// without it the counters compile out entirely. only the db_* and *_sha256 helpers should use these
+#ifdef NPMSTORAGE_INSTRUMENT
+#define INSTRUMENT_COUNT(counter, amount) (instrument_counters.counter += (amount))
+#define INSTRUMENT_WRITE(row) INSTRUMENT_COUNT(bytes_written, eosio::pack_size(row))
+#else
+#define INSTRUMENT_COUNT(counter, amount)
+#define INSTRUMENT_WRITE(row)
+#endif
+
 #define get_rloadindex(release_id, load_index) \
   (eosio::checksum256::make_from_word_sequence<uint64_t>((uint64_t)0, (uint64_t)0, release_id,(uint64_t)load_index))
 #define is_valid_file_type(file_type) \
@@ -43,6 +98,29 @@ struct semver_version_number_t {
   uint32_t patch;
 
 };
+struct snapshot_page_t {
+  uint32_t format_version;
+  name table;
+  uint32_t row_count;
+  // 0 when the table has been fully exported, otherwise pass back as cursor
+  uint64_t next_cursor;
+  // one eosio::pack()ed row per entry, in primary key order
+  std::vector<std::vector<char>> rows;
+};
+#ifdef NPMSTORAGE_INSTRUMENT
+struct instrument_counters_t {
+  uint64_t finds = 0;
+  uint64_t lower_bounds = 0;
+  uint64_t begins = 0;
+  uint64_t nexts = 0;
+  uint64_t available_primary_keys = 0;
+  uint64_t emplaces = 0;
+  uint64_t modifies = 0;
+  uint64_t erases = 0;
+  uint64_t bytes_hashed = 0;
+  uint64_t bytes_written = 0;
+};
+#endif
 struct parsed_package_version_t {
   std::string package_and_version;
   std::string package_name;
@@ -169,6 +247,87 @@ void parse_package_and_version(std::string package_and_version_raw, parsed_packa
   result.prerelease_full = prerelease_full;
 
 }
+// gear hash table: splitmix64 of each byte value
+static const uint64_t chunk_gear[256] = {
+  0xe220a8397b1dcdafULL, 0x6e789e6aa1b965f4ULL, 0x06c45d188009454fULL, 0xf88bb8a8724c81ecULL,
+  0x1b39896a51a8749bULL, 0x53cb9f0c747ea2eaULL, 0x2c829abe1f4532e1ULL, 0xc584133ac916ab3cULL,
+  0x3ee5789041c98ac3ULL, 0xf3b8488c368cb0a6ULL, 0x657eecdd3cb13d09ULL, 0xc2d326e0055bdef6ULL,
+  0x8621a03fe0bbdb7bULL, 0x8e1f7555983aa92fULL, 0xb54e0f1600cc4d19ULL, 0x84bb3f97971d80abULL,
+  0x7d29825c75521255ULL, 0xc3cf17102b7f7f86ULL, 0x3466e9a083914f64ULL, 0xd81a8d2b5a4485acULL,
+  0xdb01602b100b9ed7ULL, 0xa9038a921825f10dULL, 0xedf5f1d90dca2f6aULL, 0x54496ad67bd2634cULL,
+  0xdd7c01d4f5407269ULL, 0x935e82f1db4c4f7bULL, 0x69b82ebc92233300ULL, 0x40d29eb57de1d510ULL,
+  0xa2f09dabb45c6316ULL, 0xee521d7a0f4d3872ULL, 0xf16952ee72f3454fULL, 0x377d35dea8e40225ULL,
+  0x0c7de8064963bab0ULL, 0x05582d37111ac529ULL, 0xd254741f599dc6f7ULL, 0x69630f7593d108c3ULL,
+  0x417ef96181daa383ULL, 0x3c3c41a3b43343a1ULL, 0x6e19905dcbe531dfULL, 0x4fa9fa7324851729ULL,
+  0x84eb4454a792922aULL, 0x134f7096918175ceULL, 0x07dc930b302278a8ULL, 0x12c015a97019e937ULL,
+  0xcc06c31652ebf438ULL, 0xecee65630a691e37ULL, 0x3e84ecb1763e79adULL, 0x690ed476743aae49ULL,
+  0x774615d7b1a1f2e1ULL, 0x22b353f04f4f52daULL, 0xe3ddd86ba71a5eb1ULL, 0xdf268adeb6513356ULL,
+  0x2098eb73d4367d77ULL, 0x03d6845323ce3c71ULL, 0xc952c5620043c714ULL, 0x9b196bca844f1705ULL,
+  0x30260345dd9e0ec1ULL, 0xcf448a5882bb9698ULL, 0xf4a578dccbc87656ULL, 0xbfdeaed9a17b3c8fULL,
+  0xed79402d1d5c5d7bULL, 0x55f070ab1cbbf170ULL, 0x3e00a34929a88f1dULL, 0xe255b237b8bb18fbULL,
+  0x2a7b67af6c6ad50eULL, 0x466d5e7f3e46f143ULL, 0x42375cb399a4fc72ULL, 0x8c8a1f148a8bb259ULL,
+  0x32fcab5daed5bdfcULL, 0x9e60398c8d8553c0ULL, 0xee89cceb8c4064c0ULL, 0xdb0215941d86a66fULL,
+  0x5ccde78203c367a8ULL, 0xf1bcbc6a1ec11786ULL, 0xef054fceee954551ULL, 0xdf82012d0555c6dfULL,
+  0x292566ff72403c08ULL, 0xc4dd302a1bfa1137ULL, 0xd85f219db5c554e1ULL, 0x6a27ff807441bcd2ULL,
+  0x96a573e9b48216e8ULL, 0x46a9fdac40bf0048ULL, 0x3dd12464a0ee15b4ULL, 0x451e521296a7eea1ULL,
+  0x56e4398a98f8a0fdULL, 0x7b7dc2160e3335a7ULL, 0xc679ee0bebcb1ccaULL, 0x928d6f2d7453424eULL,
+  0x1b38994205234c6dULL, 0x8086d193a6f2b568ULL, 0x21c6e26639ac2c65ULL, 0xd9dccac414d23c6fULL,
+  0x91cd642057e00235ULL, 0x77fc607dc6589373ULL, 0x05b8abe26dd3aee7ULL, 0x12f6436ac376cc66ULL,
+  0x64952424897b2307ULL, 0xee8c2baf6343e5c3ULL, 0xdc4c613d9eba2304ULL, 0x3505b7796bd1a506ULL,
+  0x8176daf800a05f50ULL, 0x8bd8ff7a0385cdbcULL, 0x1a764a3cd78101daULL, 0xbe4d15bf6ca266acULL,
+  0xa85e1f38bb2dc749ULL, 0x56759a968493cd8cULL, 0xf3a9bce7336bd182ULL, 0x365b15013741519bULL,
+  0x1f7a44a6b109ac94ULL, 0x3521d628813cb177ULL, 0x6a77afab0f7c9370ULL, 0x179642d8cde95015ULL,
+  0x5ef102a8fb354461ULL, 0xf51c504764ed82f2ULL, 0xc58427f041ce6808ULL, 0xfad8fc45c9643c37ULL,
+  0xcf8682f9a70fa9c0ULL, 0x7e1b3b75a4005729ULL, 0x992dd867927b52d8ULL, 0x7fbd5db142f6791fULL,
+  0x370595aacab4adaeULL, 0xb1392dbdc5ab61d6ULL, 0x9fea7dfc79d452d9ULL, 0x40b12b120085641cULL,
+  0xa192afe3157c85d0ULL, 0xc847729f4e08f3a3ULL, 0x6f1384a306c41fc2ULL, 0x12d05c4045a39c19ULL,
+  0x9899202fd20f0841ULL, 0xe9c7191857e774b8ULL, 0x4eead809af5b0cc3ULL, 0xe809acafa23864a4ULL,
+  0x4da1edaba1d0f7bdULL, 0x846eb9673349f8e4ULL, 0x87bae55b86039fe8ULL, 0x7f367b8bd953eff2ULL,
+  0x3884700f650d04e1ULL, 0xbfe4b2ab46980cadULL, 0xc5fc89075299106cULL, 0x37b2fa361adea7cdULL,
+  0x7d75d813f04895b4ULL, 0x702f5b393f62c0e0ULL, 0x0a3fc775f4ecf37fULL, 0xe4b23787a352437fULL,
+  0xf83fa245c34d6363ULL, 0xb99bcf040786cf50ULL, 0x38b6ea0a0e6c9d8aULL, 0x093fdc76776e37e1ULL,
+  0x1a75e6f76ba7eee8ULL, 0x442cdcfee9660c62ULL, 0x22d58d35116b5e0bULL, 0x87d4a5180f6a3645ULL,
+  0x589fb216bd82131bULL, 0x91d031cad319aec0ULL, 0xabecf76a553d320bULL, 0xb8686cb347612dcfULL,
+  0xfcab66337c0a77f5ULL, 0xac318214381ec437ULL, 0x6eb7f0fca24494aeULL, 0xcf42861dcdc895a9ULL,
+  0x4abad7a1586d7a91ULL, 0xc21b318dc2f49745ULL, 0xd49474dc2acbd1f0ULL, 0xb1d4873747c1c8e1ULL,
+  0x5434dc8c7d015bf6ULL, 0xe1c486287511b6a9ULL, 0xa8616df62e89a193ULL, 0x31ce6319498d8347ULL,
+  0xafd0b486123d6faaULL, 0xe6495f5d102301ebULL, 0x0dc51ced17a43c52ULL, 0x8bcbcde81355ef2dULL,
+  0x2412af73fdee7cfcULL, 0xc8d589e486e29eedULL, 0x23390e8664517f89ULL, 0x251ade58e8a6849dULL,
+  0xf8555dbd2e8f9cb0ULL, 0xcb417c3eef54f7c3ULL, 0x8028f8e1aac3a919ULL, 0x10e31052acf748a0ULL,
+  0x2d886c073b1e1b78ULL, 0x972974d90df9faeeULL, 0xbc1b7b38796893baULL, 0x1958ed432070e652ULL,
+  0xca5f297197a12dccULL, 0xe025a27375704f28ULL, 0x418010a570a924fbULL, 0x9828e2941bfc419cULL,
+  0x4fbacd2f52b85c1fULL, 0x33dd5b756211cc67ULL, 0x23c8dfdd1db57ff0ULL, 0x32f81801a1a8e901ULL,
+  0x26884eac5ada36daULL, 0xcaa82f9bb42e37d4ULL, 0x19fb1a7491d6a7d1ULL, 0x5aa0243aa357f38eULL,
+  0xb31d917809e447f0ULL, 0x3f9c197225215be0ULL, 0xdc3c315a1e33c095ULL, 0x3dd399ad533e80acULL,
+  0x566f32cce8301d95ULL, 0xc880188083d9ba21ULL, 0xb9cc357f3b0e7d2eULL, 0x0237d2123a8a8d6cULL,
+  0xbf636e9aa7cbf6bdULL, 0xd7bd4284c4e2a6a7ULL, 0xda2ebb47d50577a9ULL, 0x90ba1c11b539087dULL,
+  0x44993d31552b4f57ULL, 0x32c2d6f80a8a8898ULL, 0x450583ed7fb54b19ULL, 0xec2b0b09e50ef3efULL,
+  0xd918a0b6e2efd65cULL, 0xe37a868d9785f572ULL, 0x7d1a6118f2b0f37aULL, 0x9e2e3cc13b343439ULL,
+  0xefd82c11212e37e8ULL, 0xaf89c05cd4fc75edULL, 0x55bc16bb9697108eULL, 0x6c4701fa5db69beeULL,
+  0x9237338441daf445ULL, 0x248cf0831e81a5fcULL, 0xacc13557e77de273ULL, 0x520970c25e06513aULL,
+  0x657329cb02987cabULL, 0xa9b0b3366a4e55a8ULL, 0xc4d06ca2f39acdd4ULL, 0x5dce37d68170cde1ULL,
+  0x5f1e44e77e1854c9ULL, 0x6883d452d55df899ULL, 0x05c5bd62f1067032ULL, 0xe680b683ce60fab0ULL,
+  0x5dc9da3f286d18b1ULL, 0x94b4bf3ab85ed6d8ULL, 0xce65f449e3acc5a3ULL, 0x34b0209642cea639ULL,
+  0xc14c3c771d904827ULL, 0x6addcee2bd9cdee5ULL, 0xe24eed137ffbb613ULL, 0x75dd58ef79963d1bULL,
+  0xfdb83ecf6cc24920ULL, 0x7a1d0057c57169fbULL, 0x339200f4feb62d07ULL, 0xd33f4d4ac88469f4ULL,
+  0x8226f234e68dfee4ULL, 0x320def4f2a105536ULL, 0x7786f3b13aefc159ULL, 0xb28225ac9df63ee2ULL,
+  0x781b9d0376cc6044ULL, 0x05bd0115226c6ab6ULL, 0xd302230207bdfdabULL, 0xdb898abd8e0d2933ULL,
+  0x9e79a397ba00b9ccULL, 0x89df84a5f0003ee8ULL, 0x011f04f2a75fb9beULL, 0x5a5832bb47bcf19eULL
+};
+std::size_t get_chunk_length(const char *data, std::size_t length){
+  if(length <= CHUNK_MIN_SIZE){
+    return length;
+  }
+  std::size_t max_length = length < CHUNK_MAX_SIZE ? length : CHUNK_MAX_SIZE;
+  uint64_t hash = 0;
+  for(std::size_t i = 0; i < max_length; i++){
+    hash = (hash << 1) + chunk_gear[(uint8_t)data[i]];
+    if(i+1 >= CHUNK_MIN_SIZE && (hash & CHUNK_BOUNDARY_MASK) == 0){
+      return i+1;
+    }
+  }
+  return max_length;
+}
 checksum256 get_package_version_combined(uint32_t package_name_id, uint32_t major, uint32_t minor, uint32_t patch, uint32_t prerelease_sid, uint32_t prerelease_full_sid) {
   checksum256 combined = eosio::checksum256::make_from_word_sequence<uint32_t>(package_name_id,major,minor,patch,prerelease_sid,(uint32_t)0,(uint32_t)0,prerelease_full_sid);
   return combined;
@@ -186,12 +345,31 @@ CONTRACT npmstorage : public contract {
           tbl_repos(receiver, receiver.value),
           tbl_releases(receiver, receiver.value),
           tbl_releasefiles(receiver, receiver.value),
-          tbl_resources(receiver, receiver.value) {}
+          tbl_resources(receiver, receiver.value),
+          tbl_chunks(receiver, receiver.value),
+          tbl_changeseqs(receiver, receiver.value) {}
+
+#ifdef NPMSTORAGE_INSTRUMENT
+    // printed into the console of the action trace that this instance executed
+    ~npmstorage() {
+      eosio::print("instrument{finds:", instrument_counters.finds,
+        ",lower_bounds:", instrument_counters.lower_bounds,
+        ",begins:", instrument_counters.begins,
+        ",nexts:", instrument_counters.nexts,
+        ",available_primary_keys:", instrument_counters.available_primary_keys,
+        ",emplaces:", instrument_counters.emplaces,
+        ",modifies:", instrument_counters.modifies,
+        ",erases:", instrument_counters.erases,
+        ",bytes_hashed:", instrument_counters.bytes_hashed,
+        ",bytes_written:", instrument_counters.bytes_written, "}\n");
+    }
+#endif
 
     
     // ACTION addpkgver(name user, std::string package_and_version);
     ACTION upsertrepo(name user, name repo, std::string title, std::string description, std::string url, std::string icon);
     
+    ACTION setrepoon(name user, name repo, uint32_t status);
     ACTION addrelease(name user, name repo, std::string package_and_version, uint32_t load_order);
     ACTION delrelease(name user, uint64_t release_id);
     
@@ -201,12 +379,22 @@ CONTRACT npmstorage : public contract {
     ACTION swaploadind(name user, uint64_t release_id, uint64_t releasefile_id_a, uint64_t releasefile_id_b);
 
     ACTION add(name uploader, checksum256 sha256hash, std::string data);
+    ACTION addchunked(name uploader, checksum256 sha256hash, std::string data);
+
+    // inline notifications for edge caches, only callable by the contract itself
+    ACTION logchange(name repo, uint64_t change_seq, name change, uint64_t release_id, uint32_t package_name_id);
+    ACTION logresource(uint64_t rid, checksum256 sha256hash, name uploader);
     
     
     
     
     
+    READONLY_ACTION snapshot_page_t snapshot(name table, uint64_t cursor, uint32_t max_bytes);
+
+    [[eosio::action]] uint64_t migrate(name table, uint64_t cursor, uint32_t max_bytes);
+
     ACTION devclearall();
+    ACTION devimport(name table, uint32_t format_version, std::vector<std::vector<char>> rows);
 
     TABLE s_tbl_stringstore {
       uint32_t id;
@@ -253,11 +441,14 @@ CONTRACT npmstorage : public contract {
 
       uint64_t num_releases;
 
+      eosio::binary_extension<uint32_t> schema_version;
+
 
       uint64_t primary_key()const { return id; }
       checksum256 by_hash()const { return package_and_version_hash; }
       checksum256 by_combined()const { return combined; }
       uint64_t by_creator()const { return creator.value; }
+      uint32_t get_schema_version()const { return schema_version.value_or(0); }
     };
 
     TABLE s_tbl_repos {
@@ -269,8 +460,11 @@ CONTRACT npmstorage : public contract {
       std::string icon;
       uint32_t status;
 
+      eosio::binary_extension<uint32_t> schema_version;
+
       uint64_t primary_key()const { return repo.value; }
       uint64_t by_status()const { return status; }
+      uint32_t get_schema_version()const { return schema_version.value_or(0); }
     };
 
     TABLE s_tbl_releases {
@@ -286,10 +480,13 @@ CONTRACT npmstorage : public contract {
 
       uint32_t status;
       uint64_t created_at;
+
+      eosio::binary_extension<uint32_t> schema_version;
       
       uint64_t primary_key()const { return id; }
       uint64_t by_pkg_version()const { return package_version_id; }
       checksum256 by_repo_pkgver()const { return eosio::checksum256::make_from_word_sequence<uint64_t>(repo.value, (uint64_t)package_name_id, package_version_id,(uint64_t)0); }
+      uint32_t get_schema_version()const { return schema_version.value_or(0); }
     };
 
 
@@ -310,10 +507,13 @@ CONTRACT npmstorage : public contract {
       std::string externals;
       checksum256 rloadindex;
 
+      eosio::binary_extension<uint32_t> schema_version;
+
       uint64_t primary_key()const { return id; }
       checksum256 by_rloadindex()const { return rloadindex; }
       uint64_t by_release_id()const { return release_id; }
       checksum256 by_hash()const { return sha256hash; }
+      uint32_t get_schema_version()const { return schema_version.value_or(0); }
     };
 
     TABLE s_tbl_resources {
@@ -321,8 +521,33 @@ CONTRACT npmstorage : public contract {
       name uploader;
       checksum256 sha256hash;
       std::string data;
+      // if non-empty, data is empty and the resource is the concatenation of these chunks
+      eosio::binary_extension<std::vector<uint64_t>> chunk_ids;
+      // total length of the chunks so readers can size a chunked resource without reassembling it, 0 if not chunked
+      eosio::binary_extension<uint64_t> chunked_length;
+      eosio::binary_extension<uint32_t> schema_version;
       uint64_t primary_key()const { return rid; }
       checksum256 by_hash()const { return sha256hash; }
+      bool is_chunked()const { return chunk_ids.has_value() && !chunk_ids.value().empty(); }
+      uint32_t get_schema_version()const { return schema_version.value_or(0); }
+    };
+
+    // incremented on every release change in a repo and carried by logchange so edges can detect gaps,
+    // kept apart from repos so that publishing does not rewrite the much larger repo row
+    TABLE s_tbl_changeseqs {
+      name repo;
+      uint64_t change_seq;
+      uint64_t primary_key()const { return repo.value; }
+    };
+
+    // chunks are permanent: they are shared by every resource that contains them and resources are never deleted,
+    // so the first uploader of a chunk pays for it
+    TABLE s_tbl_chunks {
+      uint64_t id;
+      checksum256 sha256hash;
+      std::string data;
+      uint64_t primary_key()const { return id; }
+      checksum256 by_hash()const { return sha256hash; }
     };
 
     typedef eosio::multi_index<"stringstore"_n, s_tbl_stringstore, 
@@ -364,12 +589,55 @@ CONTRACT npmstorage : public contract {
       eosio::indexed_by<"datahashidx"_n, eosio::const_mem_fun<s_tbl_resources, checksum256, &s_tbl_resources::by_hash> >
     > t_tbl_resources;
 
+    typedef eosio::multi_index<"chunks"_n, s_tbl_chunks, 
+      eosio::indexed_by<"byhash"_n, eosio::const_mem_fun<s_tbl_chunks, checksum256, &s_tbl_chunks::by_hash> >
+    > t_tbl_chunks;
+
+    typedef eosio::multi_index<"changeseqs"_n, s_tbl_changeseqs> t_tbl_changeseqs;
+
+    // next_cursor is 0 when there are no more rows, otherwise pass it back as cursor to get the next page.
+    // a page holds at most limit rows and QUERY_MAX_PAGE_BYTES of packed rows
+    struct repos_page_t {
+      std::vector<s_tbl_repos> rows;
+      uint64_t next_cursor;
+    };
+
+    struct releases_page_t {
+      std::vector<s_tbl_releases> rows;
+      uint64_t next_cursor;
+    };
+
+    struct versions_page_t {
+      std::vector<s_tbl_packageversions> rows;
+      uint64_t next_cursor;
+    };
+
+    struct resource_payload_t {
+      checksum256 sha256hash;
+      bool found;
+      uint64_t rid;
+      std::string data;
+    };
+
+    // next_cursor is the position of the next resource to fetch, 0 when everything has been returned
+    struct resources_page_t {
+      std::vector<resource_payload_t> resources;
+      uint32_t next_cursor;
+    };
+
+    READONLY_ACTION repos_page_t listrepos(uint32_t status, uint64_t cursor, uint32_t limit);
+    READONLY_ACTION releases_page_t listreleases(name repo, uint32_t package_name_id, uint64_t cursor, uint32_t limit);
+    READONLY_ACTION versions_page_t listversions(name creator, uint64_t cursor, uint32_t limit);
+    READONLY_ACTION resources_page_t getresources(std::vector<checksum256> hashes, uint32_t cursor, uint32_t max_bytes);
+    READONLY_ACTION resources_page_t getrelres(uint64_t release_id, uint32_t cursor, uint32_t max_bytes);
+
 
 
 
 
     //using addpkgver_action = action_wrapper<"addpkgver"_n, &npmstorage::addpkgver>;
     using upsertrepo_action = action_wrapper<"upsertrepo"_n, &npmstorage::upsertrepo>;
+    using setrepoon_action = action_wrapper<"setrepoon"_n, &npmstorage::setrepoon>;
     using addrelease_action = action_wrapper<"addrelease"_n, &npmstorage::addrelease>;
     using delrelease_action = action_wrapper<"delrelease"_n, &npmstorage::delrelease>;
     using setreleaseon_action = action_wrapper<"setreleaseon"_n, &npmstorage::setreleaseon>;
@@ -377,8 +645,21 @@ CONTRACT npmstorage : public contract {
     using addrelfile_action = action_wrapper<"addrelfile"_n, &npmstorage::addrelfile>;
     using swaploadind_action = action_wrapper<"swaploadind"_n, &npmstorage::swaploadind>;
     using add_action = action_wrapper<"add"_n, &npmstorage::add>;
+    using addchunked_action = action_wrapper<"addchunked"_n, &npmstorage::addchunked>;
+    using logchange_action = action_wrapper<"logchange"_n, &npmstorage::logchange>;
+    using logresource_action = action_wrapper<"logresource"_n, &npmstorage::logresource>;
+
+    using snapshot_action = action_wrapper<"snapshot"_n, &npmstorage::snapshot>;
+    using listrepos_action = action_wrapper<"listrepos"_n, &npmstorage::listrepos>;
+    using listreleases_action = action_wrapper<"listreleases"_n, &npmstorage::listreleases>;
+    using listversions_action = action_wrapper<"listversions"_n, &npmstorage::listversions>;
+    using getresources_action = action_wrapper<"getresources"_n, &npmstorage::getresources>;
+    using getrelres_action = action_wrapper<"getrelres"_n, &npmstorage::getrelres>;
+
+    using migrate_action = action_wrapper<"migrate"_n, &npmstorage::migrate>;
 
     using devclearall_action = action_wrapper<"devclearall"_n, &npmstorage::devclearall>;
+    using devimport_action = action_wrapper<"devimport"_n, &npmstorage::devimport>;
     
 /*
 
@@ -404,9 +685,38 @@ CONTRACT npmstorage : public contract {
     t_tbl_releasefiles tbl_releasefiles;
 
     t_tbl_resources tbl_resources;
+    t_tbl_chunks tbl_chunks;
+
+    t_tbl_changeseqs tbl_changeseqs;
     
 
   private:
+#ifdef NPMSTORAGE_INSTRUMENT
+    instrument_counters_t instrument_counters;
+#endif
+
+    // every table access and hash goes through these so that NPMSTORAGE_INSTRUMENT builds can count them
+    template<typename I, typename K>
+    typename I::const_iterator db_find(const I &index, const K &key);
+    template<typename I, typename K>
+    typename I::const_iterator db_lower_bound(const I &index, const K &key);
+    template<typename I>
+    typename I::const_iterator db_begin(const I &index);
+    template<typename It>
+    void db_next(It &iterator);
+    template<typename I, typename R>
+    typename I::const_iterator db_iterator_to(const I &index, const R &row);
+    template<typename T>
+    uint64_t db_available_primary_key(const T &table);
+    template<typename T, typename F>
+    typename T::const_iterator db_emplace(T &table, name payer, F &&constructor);
+    template<typename I, typename F>
+    void db_modify(I &index, typename I::const_iterator iterator, name payer, F &&updater);
+    template<typename I>
+    typename I::const_iterator db_erase(I &index, typename I::const_iterator iterator);
+    checksum256 hash_sha256(const char *data, std::size_t length);
+    void check_sha256(const char *data, std::size_t length, const checksum256 &hash);
+
     uint32_t add_value_to_stringstore(name user, std::string value, bool error_if_exists);
     uint32_t add_value_to_packagenames(name user, std::string package_name, bool error_if_exists);
     uint64_t add_package_version(name user, std::string package_and_version, bool error_if_exists);
@@ -415,10 +725,47 @@ CONTRACT npmstorage : public contract {
     auto assert_user_owns_repo(name user, name repo);
     auto assert_user_owns_release(name user, uint64_t release_id);
     void upsert_repo_content(name user, name repo, std::string title, std::string description, std::string url, std::string icon);
+    void set_repo_status(name user, name repo, uint32_t status);
     void add_new_release(name user, name repo, std::string package_and_version, uint32_t load_order);
     void set_release_status(name user, uint64_t release_id, uint32_t status);
     void set_release_load_order(name user, uint64_t release_id, uint32_t load_order);
     void add_release_file(name user, uint64_t release_id, checksum256 filehash, std::string alt_sources, std::string externals, uint32_t file_type, uint32_t load_index);
+    void swap_release_file_load_index(name user, uint64_t release_id, uint64_t releasefile_id_a, uint64_t releasefile_id_b);
+    void notify_release_change(const s_tbl_releases &release, name change);
+    uint64_t add_chunk(name user, const char *data, std::size_t length);
+    std::string get_resource_data(const s_tbl_resources &resource);
+    uint64_t get_resource_length(const s_tbl_resources &resource);
+
+    // bounded pages: cursor 0 starts at the beginning, otherwise it is the next row's primary key + 1. visits rows
+    // from iterator while in_range holds, up to max_rows rows and max_bytes packed bytes but always at least one row,
+    // and returns the cursor for the next page (0 when there are no more rows)
+    template<typename I, typename R, typename V>
+    uint64_t walk_page(const I &index, typename I::const_iterator iterator, R in_range, uint32_t max_rows, uint32_t max_bytes, V visit);
+    // walk_page over a whole table in primary key order, starting at cursor
+    template<typename T, typename V>
+    uint64_t walk_table_page(T &table, uint64_t cursor, uint32_t max_bytes, V visit);
+
+    void migrate_row(s_tbl_packageversions &row);
+    void migrate_row(s_tbl_repos &row);
+    void migrate_row(s_tbl_releases &row);
+    void migrate_row(s_tbl_releasefiles &row);
+    void migrate_row(s_tbl_resources &row);
+    template<typename T, uint32_t readable_version>
+    uint64_t migrate_table_rows(T &table, uint64_t cursor, uint32_t max_bytes);
+
+    template<typename P, typename T, typename I, typename K, typename F>
+    void query_index_page(T &table, I &index, const K &lower_key, F in_range, uint64_t cursor, uint32_t limit, P &page);
+
+    bool append_resource_payload(const s_tbl_resources &resource, uint32_t max_bytes, uint64_t &page_bytes, resources_page_t &page);
+
+    template<typename T>
+    void export_snapshot_rows(T &table, uint64_t cursor, uint32_t max_bytes, snapshot_page_t &page);
+    template<typename R, typename T>
+    void import_snapshot_rows(T &table, const std::vector<std::vector<char>> &rows);
+    template<typename R>
+    void verify_snapshot_row(const R &row) {}
+    void verify_snapshot_row(const s_tbl_resources &row);
+    void verify_snapshot_row(const s_tbl_chunks &row);
 
 
 